@@ -0,0 +1,418 @@
+// host_test/cmd_wheel/test_cmd_wheel.c
+// Host tests for main/CmdWheel.c: fire accuracy across all wheel levels and the
+// overflow list, cascade boundaries, fade step timing, supersede, target pinning,
+// the reserve for immediate commands, execute-at to tick conversion, and insert / expiry cost at scale.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CmdWheel.h"
+
+static int s_failed = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { s_failed++; \
+    printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+/* ---------- harness ---------- */
+#define MAX_N 16384
+
+static cmd_wheel_entry_t  s_entries[MAX_N];
+static cmd_wheel_target_t s_targets[256];
+
+typedef struct { uint32_t tick; gw_cmd_t c; } emit_rec_t;
+static emit_rec_t s_log[4096];
+static int s_nlog = 0;
+static uint32_t s_fired_at[MAX_N];
+static int s_fired = 0;
+
+static void emit_log(const gw_cmd_t *c){
+    if (s_nlog < (int)(sizeof(s_log) / sizeof(s_log[0]))) {
+        s_log[s_nlog].tick = cmd_wheel_tick();
+        s_log[s_nlog].c = *c;
+    }
+    s_nlog++;
+}
+static void emit_index(const gw_cmd_t *c){
+    s_fired_at[atoi(c->id)] = cmd_wheel_tick();
+    s_fired++;
+}
+
+static void setup(size_t n_entries, size_t n_targets, cmd_wheel_emit_fn emit, uint32_t now){
+    cmd_wheel_config_t cfg = {
+        .tick_ms = 10, .step_ms = 200, .emit = emit,
+        .entries = s_entries, .n_entries = n_entries,
+        .targets = s_targets, .n_targets = n_targets,
+    };
+    cmd_wheel_init(&cfg, now);
+    s_nlog = 0;
+    s_fired = 0;
+}
+static gw_cmd_t mk_cmd(const char *id, const char *target, bool on, uint8_t bri, uint32_t transition_ms){
+    gw_cmd_t c = {0};
+    c.valid = true; c.on = on;
+    c.r = c.g = c.b = 0xFF; c.brightness = bri;
+    c.transition_ms = transition_ms;
+    snprintf(c.id, sizeof(c.id), "%s", id);
+    snprintf(c.target, sizeof(c.target), "%s", target);
+    return c;
+}
+
+/* ---------- tests ---------- */
+
+// Thousands of entries with delays on every level (and past the wheel horizon)
+// fire on exactly their tick, also across the uint32 tick wrap.
+static void test_exact_fire_ticks(uint32_t base){
+    const int n = 8192;
+    static uint32_t want[MAX_N];
+    setup(n, 4, emit_index, base);
+    srand(base ^ 0x5eed);
+
+    uint32_t last = base;
+    for (int i = 0; i < n; ++i) {
+        uint32_t d;
+        switch (i % 5) {
+        case 0:  d = rand() % 64; break;
+        case 1:  d = 64 + rand() % (4096 - 64); break;
+        case 2:  d = 4096 + rand() % ((1u << 18) - 4096); break;
+        case 3:  d = (1u << 18) + rand() % ((1u << 24) - (1u << 18)); break;
+        default: d = (1u << 24) + rand() % (1u << 24); break;   // overflow list
+        }
+        char id[16]; snprintf(id, sizeof(id), "%d", i);
+        gw_cmd_t c = mk_cmd(id, "t", true, 255, 0);
+        want[i] = base + d;
+        CHECK(cmd_wheel_add(&c, want[i]), "add %d", i);
+        if ((int32_t)(want[i] - last) > 0) last = want[i];
+    }
+    cmd_wheel_run(last);
+
+    int bad = 0;
+    for (int i = 0; i < n; ++i) {
+        if (s_fired_at[i] != want[i] && bad++ < 5)
+            printf("  entry %d: want %u got %u\n", i, want[i], s_fired_at[i]);
+    }
+    CHECK(s_fired == n, "base %u: fired %d of %d", base, s_fired, n);
+    CHECK(bad == 0, "base %u: %d entries fired on the wrong tick", base, bad);
+    CHECK(cmd_wheel_free() == (size_t)n, "pool not returned");
+}
+
+// Delays right on the level boundaries, inserted at awkward wheel positions
+static void test_cascade_boundaries(void){
+    static const uint32_t deltas[] = {
+        0, 1, 63, 64, 65, 4095, 4096, 4097,
+        (1u << 18) - 1, 1u << 18, (1u << 18) + 1,
+        (1u << 24) - 1, 1u << 24, (1u << 24) + 1, (1u << 25) + 3,
+    };
+    static const uint32_t starts[] = { 0, 1, 63, 64, 4095, 4096, (1u << 18) - 1, (1u << 24) - 1, 0xFFFFFFC0u };
+    const int nd = sizeof(deltas) / sizeof(deltas[0]);
+
+    for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); ++s) {
+        setup(nd, 4, emit_index, starts[s]);
+        for (int i = 0; i < nd; ++i) {
+            char id[16]; snprintf(id, sizeof(id), "%d", i);
+            gw_cmd_t c = mk_cmd(id, "t", true, 255, 0);
+            cmd_wheel_add(&c, starts[s] + deltas[i]);
+        }
+        cmd_wheel_run(starts[s] + deltas[nd - 1]);
+        CHECK(s_fired == nd, "start %u: fired %d of %d", starts[s], s_fired, nd);
+        for (int i = 0; i < nd; ++i) {
+            CHECK(s_fired_at[i] == starts[s] + deltas[i], "start %u delta %u: fired at +%u",
+                  starts[s], deltas[i], s_fired_at[i] - starts[s]);
+        }
+    }
+}
+
+// 1000 ms fade, 200 ms steps, 10 ms ticks: steps at 200..800 ms, final at 1000 ms
+static void test_fade_timing(void){
+    setup(16, 8, emit_log, 0);
+    gw_cmd_t c = mk_cmd("f", "lamp", true, 255, 1000);
+    cmd_wheel_add(&c, 100);
+    cmd_wheel_run(400);
+
+    static const uint32_t ticks[] = { 120, 140, 160, 180, 200 };
+    static const uint8_t  bri[]   = { 51, 102, 153, 204, 255 };
+    CHECK(s_nlog == 5, "fade sent %d emits, want 5", s_nlog);
+    for (int i = 0; i < 5 && i < s_nlog; ++i) {
+        CHECK(s_log[i].tick == ticks[i], "step %d at tick %u, want %u", i + 1, s_log[i].tick, ticks[i]);
+        CHECK(s_log[i].c.brightness == bri[i], "step %d brightness %u, want %u", i + 1, s_log[i].c.brightness, bri[i]);
+        CHECK(s_log[i].c.on, "step %d sent off", i + 1);
+    }
+
+    // Transition not a multiple of the step: last step at 1000 ms, final at 1100 ms
+    setup(16, 8, emit_log, 0);
+    c = mk_cmd("g", "lamp", true, 220, 1100);
+    cmd_wheel_add(&c, 0);
+    cmd_wheel_run(400);
+    CHECK(s_nlog == 6, "1100 ms fade sent %d emits, want 6", s_nlog);
+    CHECK(s_nlog >= 6 && s_log[4].tick == 100 && s_log[5].tick == 110,
+          "1100 ms fade: last step / final at ticks %u / %u", s_log[4].tick, s_log[5].tick);
+    CHECK(s_nlog >= 6 && s_log[5].c.brightness == 220, "final brightness %u", s_log[5].c.brightness);
+
+    // Fade to off ends with the real off command
+    c = mk_cmd("h", "lamp", false, 220, 400);
+    cmd_wheel_add(&c, 500);
+    cmd_wheel_run(600);
+    CHECK(s_nlog == 8, "off fade sent %d emits total, want 8", s_nlog);
+    CHECK(s_nlog >= 8 && s_log[6].tick == 520 && s_log[6].c.on && s_log[6].c.brightness == 110,
+          "off fade step: tick %u bri %u", s_log[6].tick, s_log[6].c.brightness);
+    CHECK(s_nlog >= 8 && s_log[7].tick == 540 && !s_log[7].c.on, "off fade final: tick %u on %d",
+          s_log[7].tick, s_log[7].c.on);
+}
+
+// Received 450 ms late: first emit is step 2 right away, then back on the shared schedule
+static void test_fade_late_join(void){
+    setup(16, 8, emit_log, 1000);
+    gw_cmd_t c = mk_cmd("late", "lamp", true, 255, 1000);
+    cmd_wheel_add(&c, 1000 - 45);
+    cmd_wheel_run(1200);
+
+    CHECK(s_nlog == 4, "late fade sent %d emits, want 4", s_nlog);
+    CHECK(s_nlog >= 1 && s_log[0].tick == 1000 && s_log[0].c.brightness == 102,
+          "late join: tick %u bri %u", s_log[0].tick, s_log[0].c.brightness);
+    CHECK(s_nlog >= 4 && s_log[1].tick == 1015 && s_log[3].tick == 1055 && s_log[3].c.brightness == 255,
+          "late join schedule: %u .. %u", s_log[1].tick, s_log[3].tick);
+
+    // Later than the whole transition: just the final command
+    setup(16, 8, emit_log, 1000);
+    cmd_wheel_add(&c, 1000 - 500);
+    cmd_wheel_run(1200);
+    CHECK(s_nlog == 1 && s_log[0].c.brightness == 255, "expired fade sent %d emits", s_nlog);
+}
+
+// A newer command for the target stops the older fade; "all" stops every fade, and a
+// newer per-target command takes its target out of a running "all" fade
+static void test_supersede(void){
+    setup(16, 8, emit_log, 0);
+    gw_cmd_t fade = mk_cmd("fade", "lamp", true, 255, 1000);
+    gw_cmd_t off  = mk_cmd("off", "lamp", false, 0, 0);
+    cmd_wheel_add(&fade, 0);
+    cmd_wheel_add(&off, 50);
+    cmd_wheel_run(300);
+    CHECK(s_nlog == 3, "superseded fade: %d emits, want 3", s_nlog);
+    CHECK(s_nlog >= 3 && !s_log[2].c.on && s_log[2].tick == 50, "last emit must be the newer off");
+    CHECK(cmd_wheel_free() == 16, "superseded entry not freed");
+
+    // The newer command fades from where the old one was cut off
+    setup(16, 8, emit_log, 0);
+    gw_cmd_t down = mk_cmd("down", "lamp", true, 0, 400);
+    cmd_wheel_add(&fade, 0);
+    cmd_wheel_add(&down, 50);
+    cmd_wheel_run(300);
+    CHECK(s_nlog == 4, "takeover: %d emits, want 4", s_nlog);
+    CHECK(s_nlog >= 3 && s_log[2].tick == 70 && s_log[2].c.brightness == 51,
+          "takeover step: tick %u bri %u", s_nlog >= 3 ? s_log[2].tick : 0, s_nlog >= 3 ? s_log[2].c.brightness : 0);
+
+    setup(16, 8, emit_log, 0);
+    gw_cmd_t a = mk_cmd("a", "lamp-a", true, 255, 1000);
+    gw_cmd_t b = mk_cmd("b", "lamp-b", true, 255, 1000);
+    gw_cmd_t all = mk_cmd("all", "all", true, 10, 0);
+    cmd_wheel_add(&a, 0);
+    cmd_wheel_add(&b, 0);
+    cmd_wheel_add(&all, 30);
+    cmd_wheel_run(300);
+    CHECK(s_nlog == 3 && strcmp(s_log[2].c.target, "all") == 0, "all: %d emits, want 3", s_nlog);
+
+    // Group fade, then "lamp-a off": the fade carries on for lamp-b only
+    setup(16, 8, emit_log, 0);
+    gw_cmd_t ka = mk_cmd("ka", "lamp-a", true, 0, 0);
+    gw_cmd_t kb = mk_cmd("kb", "lamp-b", true, 0, 0);
+    gw_cmd_t group = mk_cmd("group", "all", true, 255, 1000);
+    gw_cmd_t a_off = mk_cmd("a-off", "lamp-a", false, 0, 0);
+    cmd_wheel_add(&ka, 0);
+    cmd_wheel_add(&kb, 0);
+    cmd_wheel_add(&group, 5);
+    cmd_wheel_add(&a_off, 50);
+    cmd_wheel_run(300);
+
+    int before = 0, a_after = 0, all_after = 0, b_after = 0;
+    uint8_t b_last = 0; uint32_t b_last_tick = 0;
+    for (int i = 0; i < s_nlog; ++i) {
+        const emit_rec_t *r = &s_log[i];
+        if (r->tick < 50) { if (strcmp(r->c.target, "all") == 0) before++; continue; }
+        if (strcmp(r->c.target, "lamp-a") == 0 && strcmp(r->c.id, "a-off") != 0) a_after++;
+        if (strcmp(r->c.target, "all") == 0) all_after++;
+        if (strcmp(r->c.target, "lamp-b") == 0) { b_after++; b_last = r->c.brightness; b_last_tick = r->tick; }
+    }
+    CHECK(before == 2, "group fade broadcast %d steps before the override, want 2", before);
+    CHECK(a_after == 0, "group fade still sent %d steps to the overridden lamp-a", a_after);
+    CHECK(all_after == 0, "group fade still broadcast %d times after the override", all_after);
+    CHECK(b_after == 3 && b_last == 255 && b_last_tick == 105,
+          "lamp-b after override: %d emits, last bri %u at tick %u", b_after, b_last, b_last_tick);
+}
+
+// The mesh gets the full commandId, also for ids that only differ at the end
+static void test_full_command_id(void){
+    static const char *ids[] = {
+        "2026-10-18T18:00:00.000Z-group-sunset-fade-0001",
+        "2026-10-18T18:00:00.000Z-group-sunset-fade-0002",
+    };
+    setup(16, 8, emit_log, 0);
+    for (int i = 0; i < 2; ++i) {
+        gw_cmd_t c = mk_cmd(ids[i], i ? "lamp-b" : "lamp-a", true, 10, i ? 400 : 0);
+        cmd_wheel_add(&c, 0);
+    }
+    cmd_wheel_run(100);
+    CHECK(s_nlog == 3, "id test: %d emits, want 3", s_nlog);
+    for (int i = 0; i < s_nlog && i < 3; ++i) {
+        const char *want = strcmp(s_log[i].c.target, "lamp-a") == 0 ? ids[0] : ids[1];
+        CHECK(strcmp(s_log[i].c.id, want) == 0, "emit %d id '%s', want '%s'", i, s_log[i].c.id, want);
+    }
+}
+
+// Group fade on more targets than are ever idle: running fades keep their target
+// slot even while other targets churn through the table.
+static void test_target_pinning(void){
+    const int n_fades = 40;
+    setup(512, 48, emit_log, 0);
+    for (int i = 0; i < n_fades; ++i) {
+        char t[16]; snprintf(t, sizeof(t), "node-%d", i);
+        gw_cmd_t c = mk_cmd(t, t, true, 200, 2000);
+        CHECK(cmd_wheel_add(&c, 0), "fade %d rejected", i);
+    }
+    for (uint32_t tick = 0; tick <= 250; ++tick) {
+        char t[16]; snprintf(t, sizeof(t), "other-%u", tick);
+        gw_cmd_t c = mk_cmd(t, t, true, 1, 0);
+        cmd_wheel_add(&c, tick);
+        cmd_wheel_run(tick);
+    }
+
+    int fade_emits = 0, finals = 0;
+    for (int i = 0; i < s_nlog && i < (int)(sizeof(s_log) / sizeof(s_log[0])); ++i) {
+        if (strncmp(s_log[i].c.target, "node-", 5) != 0) continue;
+        fade_emits++;
+        if (s_log[i].c.brightness == 200 && s_log[i].tick == 200) finals++;
+    }
+    CHECK(fade_emits == n_fades * 10, "fade emits %d, want %d", fade_emits, n_fades * 10);
+    CHECK(finals == n_fades, "fades reaching their final state: %d of %d", finals, n_fades);
+
+    // Every slot pinned: add is refused instead of evicting
+    setup(64, 4, emit_log, 0);
+    for (int i = 0; i < 4; ++i) {
+        char t[16]; snprintf(t, sizeof(t), "p%d", i);
+        gw_cmd_t c = mk_cmd(t, t, true, 1, 0);
+        cmd_wheel_add(&c, 100);
+    }
+    gw_cmd_t extra = mk_cmd("x", "x", true, 1, 0);
+    CHECK(!cmd_wheel_add(&extra, 0), "add must fail when every target is pinned");
+    cmd_wheel_run(100);
+    CHECK(cmd_wheel_add(&extra, 101), "add must succeed once targets are released");
+}
+
+// A wheel filled with future commands still takes commands that are due now or late
+static void test_reserve(void){
+    cmd_wheel_config_t cfg = {
+        .tick_ms = 10, .step_ms = 200, .emit = emit_log,
+        .entries = s_entries, .n_entries = 8,
+        .targets = s_targets, .n_targets = 8,
+        .reserve_entries = 2, .reserve_targets = 2,
+    };
+    cmd_wheel_init(&cfg, 100);
+    s_nlog = 0;
+
+    // Entry reserve: 6 future commands fit, the 7th does not
+    for (int i = 0; i < 6; ++i) {
+        char id[16]; snprintf(id, sizeof(id), "f%d", i);
+        gw_cmd_t c = mk_cmd(id, "t", true, 1, 0);
+        CHECK(cmd_wheel_add(&c, 1000), "future %d rejected", i);
+    }
+    gw_cmd_t later = mk_cmd("later", "t", true, 1, 0);
+    CHECK(!cmd_wheel_add(&later, 101), "future command must not take the reserve");
+    gw_cmd_t now = mk_cmd("now", "t", true, 2, 0);
+    gw_cmd_t late = mk_cmd("late", "t", true, 3, 0);
+    CHECK(cmd_wheel_add(&now, 100), "due command rejected");
+    CHECK(cmd_wheel_add(&late, 50), "late command rejected");
+    CHECK(!cmd_wheel_add(&now, 100), "pool exhausted, add must fail");
+    cmd_wheel_run(100);
+    CHECK(s_nlog == 2, "due commands fired %d times, want 2", s_nlog);
+
+    // Target reserve: future commands for new names stop with 2 unpinned slots left,
+    // known names and due commands still get in
+    cfg.n_entries = 64;
+    cmd_wheel_init(&cfg, 0);
+    for (int i = 0; i < 6; ++i) {
+        char t[16]; snprintf(t, sizeof(t), "n%d", i);
+        gw_cmd_t c = mk_cmd(t, t, true, 1, 0);
+        CHECK(cmd_wheel_add(&c, 500), "future target %d rejected", i);
+    }
+    gw_cmd_t fresh = mk_cmd("x", "new", true, 1, 0);
+    gw_cmd_t known = mk_cmd("y", "n0", true, 1, 0);
+    CHECK(!cmd_wheel_add(&fresh, 500), "future command must not take a reserved target slot");
+    CHECK(cmd_wheel_add(&known, 500), "future command for a known target rejected");
+    CHECK(cmd_wheel_add(&fresh, 0), "due command for a new target rejected");
+}
+
+// executeAt -> start tick with 10 ms ticks
+static void test_start_tick(void){
+    setup(16, 8, emit_log, 0);
+    const int64_t now_ms = 1760000000000LL;
+    static const struct { int64_t exec_at; uint32_t now_tick; uint32_t want; const char *what; } cases[] = {
+        { 0,                    500,         500,                       "zero -> now" },
+        { -5,                   500,         500,                       "negative -> now" },
+        { now_ms,               500,         500,                       "exactly now" },
+        { now_ms + 1,           500,         501,                       "1 ms ahead rounds up" },
+        { now_ms + 1000,        500,         600,                       "future, whole ticks" },
+        { now_ms + 1005,        500,         601,                       "future, partial tick" },
+        { now_ms + 1000,        0xFFFFFFF0u, 0xFFFFFFF0u + 100,         "future across the tick wrap" },
+        { now_ms + (1LL << 40), 500,         500u + INT32_MAX,          "far future clamps" },
+        { now_ms - 1000,        500,         400,                       "late, whole ticks" },
+        { now_ms - 1005,        500,         400,                       "late, partial tick" },
+        { now_ms - 1000,        50,          50u - 100,                 "late across the tick wrap" },
+        { 1,                    500,         500u - CMD_WHEEL_MAX_LATE_TICKS, "very late clamps" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        uint32_t got = cmd_wheel_start_tick(cases[i].exec_at, now_ms, cases[i].now_tick);
+        CHECK(got == cases[i].want, "%s: got %u want %u", cases[i].what, got, cases[i].want);
+    }
+}
+
+// Slot moves per entry stay bounded by the number of levels, whatever N is
+static void test_cost_at_scale(void){
+    static const int sizes[] = { 1024, 4096, 16384 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        int n = sizes[s];
+        setup(n, 4, emit_index, 0);
+        srand(n);
+
+        clock_t t0 = clock();
+        for (int i = 0; i < n; ++i) {
+            char id[16]; snprintf(id, sizeof(id), "%d", i);
+            gw_cmd_t c = mk_cmd(id, "t", true, 1, 0);
+            cmd_wheel_add(&c, 1 + (uint32_t)rand() % (1u << 20));
+        }
+        clock_t t1 = clock();
+        uint32_t insert_moves = cmd_wheel_moves();
+        cmd_wheel_run(1u << 20);
+        clock_t t2 = clock();
+        uint32_t moves = cmd_wheel_moves();
+
+        CHECK(s_fired == n, "N=%d fired %d", n, s_fired);
+        CHECK(insert_moves == (uint32_t)n, "N=%d: %u moves to insert", n, insert_moves);
+        CHECK(moves <= (uint32_t)n * CMD_WHEEL_LEVELS, "N=%d: %u slot moves, bound %u",
+              n, moves, (uint32_t)n * CMD_WHEEL_LEVELS);
+        printf("  N=%5d: insert %.0f ns/entry, %.2f moves/entry, run over 2^20 ticks %.1f ms\n",
+               n, 1e9 * (double)(t1 - t0) / CLOCKS_PER_SEC / n, (double)moves / n,
+               1e3 * (double)(t2 - t1) / CLOCKS_PER_SEC);
+    }
+}
+
+int main(void){
+    test_exact_fire_ticks(7);
+    test_exact_fire_ticks(0x00C00005u);      // overflow entries added mid top-level cycle
+    test_exact_fire_ticks(0xFF000000u);
+    test_cascade_boundaries();
+    test_fade_timing();
+    test_fade_late_join();
+    test_supersede();
+    test_full_command_id();
+    test_target_pinning();
+    test_reserve();
+    test_start_tick();
+    test_cost_at_scale();
+
+    if (s_failed) {
+        printf("%d check(s) failed\n", s_failed);
+        return 1;
+    }
+    printf("all cmd_wheel tests passed\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+// main/CmdScheduler.c
+// Gateway-side scheduled / timed commands
+// - Commands carry an optional execute-at (Unix epoch ms, SNTP) and transition time
+// - The timer wheel, fades and per-target state live in CmdWheel.c (plain C, host-tested);
+//   this file owns the FreeRTOS task, the clocks and the memory
+// - Only sched_task touches the wheel. The poller hands commands over through a queue,
+//   so deleting the poller mid-submit can never leave a lock held
+
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "CmdScheduler.h"
+
+static const char *TAG = "Sched";
+
+#define SCHED_TICK_MS      CONFIG_GW_SCHED_TICK_MS
+#define SCHED_STEP_MS      CONFIG_GW_SCHED_STEP_MS
+#define SCHED_MAX_ENTRIES  CONFIG_GW_SCHED_MAX_ENTRIES
+#define SCHED_MAX_TARGETS  CONFIG_GW_SCHED_MAX_TARGETS
+
+#define TIME_VALID_EPOCH_S 1700000000  // anything before Nov 2023 means "SNTP not synced yet"
+#define SCHED_QUEUE_LEN    8
+#define SCHED_MIN_ENTRIES  16
+#define SCHED_MIN_TARGETS  8
+
+static QueueHandle_t s_queue = NULL;
+static int64_t s_base_ms = 0;           // esp_timer ms at wheel tick 0
+static gw_cmd_t s_parked[SCHED_QUEUE_LEN];  // taken off the queue but not yet in the wheel
+static int s_nparked = 0;
+
+/* ---------- clocks ---------- */
+static int64_t epoch_ms(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+// True once SNTP has set the wall clock
+static bool time_valid(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec >= TIME_VALID_EPOCH_S;
+}
+static uint32_t mono_tick(void){
+    return (uint32_t)((esp_timer_get_time() / 1000 - s_base_ms) / SCHED_TICK_MS);
+}
+
+/* ---------- memory ---------- */
+// Largest table (halving from `want`, not below `min`) that fits; PSRAM first when present
+static void *alloc_table(size_t want, size_t min, size_t elem, size_t *got){
+    for (size_t n = want; n >= min; n /= 2) {
+        void *p = NULL;
+#if CONFIG_SPIRAM
+        p = heap_caps_calloc(n, elem, MALLOC_CAP_SPIRAM);
+#endif
+        if (!p) p = heap_caps_calloc(n, elem, MALLOC_CAP_8BIT);
+        if (p) { *got = n; return p; }
+    }
+    return NULL;
+}
+
+// Wheel tick at which a freshly dequeued command should start
+static uint32_t start_tick(const gw_cmd_t *c){
+    return cmd_wheel_start_tick(time_valid() ? c->exec_at_ms : 0, epoch_ms(), mono_tick());
+}
+
+static void sched_task(void *arg){
+    TickType_t delay = pdMS_TO_TICKS(SCHED_TICK_MS);
+    if (delay == 0) delay = 1;
+    gw_cmd_t c;
+
+    while (1) {
+        vTaskDelay(delay);
+
+        // Parked commands retry first, oldest first, so a target's commands stay in order
+        int kept = 0;
+        for (int i = 0; i < s_nparked; ++i) {
+            if (!cmd_wheel_add(&s_parked[i], start_tick(&s_parked[i]))) s_parked[kept++] = s_parked[i];
+        }
+        s_nparked = kept;
+
+        // A command that does not fit is parked rather than left at the queue head, so
+        // immediate commands behind it still reach the wheel's reserve. Once the parking
+        // area is full too, the queue fills up and submit() tells the poller to retry
+        while (s_nparked < SCHED_QUEUE_LEN && xQueueReceive(s_queue, &c, 0) == pdTRUE) {
+            if (!cmd_wheel_add(&c, start_tick(&c))) {
+                ESP_LOGW(TAG, "scheduler full, ID:%s waiting", c.id);
+                s_parked[s_nparked++] = c;
+            }
+        }
+        cmd_wheel_run(mono_tick());
+    }
+}
+
+/* ---------- public ---------- */
+void cmd_scheduler_start(cmd_scheduler_emit_fn emit){
+    if (s_queue) return;
+
+    // Never abort on a config that does not fit: shrink, and if even the minimum
+    // does not fit, leave the scheduler off so submit() reports it
+    size_t n_entries = 0, n_targets = 0;
+    cmd_wheel_entry_t *entries = alloc_table(SCHED_MAX_ENTRIES, SCHED_MIN_ENTRIES, sizeof(cmd_wheel_entry_t), &n_entries);
+    cmd_wheel_target_t *targets = alloc_table(SCHED_MAX_TARGETS, SCHED_MIN_TARGETS, sizeof(cmd_wheel_target_t), &n_targets);
+    QueueHandle_t q = xQueueCreate(SCHED_QUEUE_LEN, sizeof(gw_cmd_t));
+    if (!entries || !targets || !q) {
+        ESP_LOGE(TAG, "no memory for the scheduler -> commands run immediately");
+        heap_caps_free(entries);
+        heap_caps_free(targets);
+        if (q) vQueueDelete(q);
+        return;
+    }
+    if (n_entries < SCHED_MAX_ENTRIES || n_targets < SCHED_MAX_TARGETS) {
+        ESP_LOGW(TAG, "scheduler shrunk to %u entries / %u targets to fit in RAM",
+                 (unsigned)n_entries, (unsigned)n_targets);
+    }
+
+    s_base_ms = esp_timer_get_time() / 1000;
+    cmd_wheel_config_t cfg = {
+        .tick_ms = SCHED_TICK_MS, .step_ms = SCHED_STEP_MS, .emit = emit,
+        .entries = entries, .n_entries = n_entries,
+        .targets = targets, .n_targets = n_targets,
+        // 1/8 of each table only ever holds commands that are due now or late
+        .reserve_entries = n_entries / 8, .reserve_targets = n_targets / 8,
+    };
+    cmd_wheel_init(&cfg, 0);
+    s_queue = q;
+
+    xTaskCreatePinnedToCore(sched_task, "sched", 4096, NULL, 6, NULL, 1);
+    ESP_LOGI(TAG, "timer wheel: %u entries, %u targets, tick %d ms, step %d ms",
+             (unsigned)n_entries, (unsigned)n_targets, SCHED_TICK_MS, SCHED_STEP_MS);
+}
+
+esp_err_t cmd_scheduler_submit(const gw_cmd_t *c){
+    if (!s_queue) return ESP_ERR_INVALID_STATE;
+
+    int64_t delay_ms = 0;
+    if (c->exec_at_ms > 0) {
+        // Right after boot the first poll usually beats SNTP; running it now would be hours early
+        if (!time_valid()) {
+            ESP_LOGI(TAG, "ID:%s has executeAt but SNTP not synced yet -> deferred", c->id);
+            return ESP_ERR_NOT_FINISHED;
+        }
+        delay_ms = c->exec_at_ms - epoch_ms();
+    }
+    // 7 days is < 2^31 ticks even at 1 ms, so start_tick() never has to clamp
+    if (delay_ms > GW_SCHED_MAX_AHEAD_MS) {
+        ESP_LOGE(TAG, "ID:%s rejected: executeAt is %lld ms away, limit is %lld ms",
+                 c->id, (long long)delay_ms, (long long)GW_SCHED_MAX_AHEAD_MS);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xQueueSend(s_queue, c, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "scheduler queue full, ID:%s deferred", c->id);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (delay_ms > 0 || c->transition_ms > 0) {
+        ESP_LOGI(TAG, "scheduled ID:%s [%s] in %lld ms, transition %lu ms",
+                 c->id, c->target, (long long)delay_ms, (unsigned long)c->transition_ms);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "CmdWheel.h"     // gw_cmd_t
+
+// Contract with the cloud: executeAt may be at most this far ahead
+#define GW_SCHED_MAX_AHEAD_MS  (7LL * 24 * 3600 * 1000)
+
+// Called from the scheduler task for every due command and every
+// interpolated transition step.
+typedef cmd_wheel_emit_fn cmd_scheduler_emit_fn;
+
+// Call once at boot. Allocates the entry pool / target table and starts the timer-wheel task.
+void cmd_scheduler_start(cmd_scheduler_emit_fn emit);
+
+// Hand a command to the scheduler task for its execute-at time (or the next tick).
+// Never blocks and takes no lock, so the caller may be deleted at any point.
+// ESP_ERR_NO_MEM: scheduler queue full (wheel is full), retry later.
+// ESP_ERR_NOT_FINISHED: has executeAt but SNTP has not synced yet, retry later.
+// ESP_ERR_INVALID_ARG: executeAt more than GW_SCHED_MAX_AHEAD_MS ahead, rejected.
+// ESP_ERR_INVALID_STATE: scheduler not running (no memory at boot), send it directly.
+esp_err_t cmd_scheduler_submit(const gw_cmd_t *c);
@@ -0,0 +1,316 @@
+// main/CmdWheel.c
+// Hierarchical timer wheel for scheduled / timed commands (plain C, host-testable)
+// - 4 levels x 64 slots: O(1) insert, O(1) expiry per tick, entries cascade down
+//   a level as their time approaches (same scheme as the classic Linux timer wheel)
+// - Entries further out than 2^24 ticks wait on an overflow list that is re-checked
+//   each time the top level wraps (anything still out of range then is >= 2^24 away)
+// - Transitions re-arm the same entry at start + i*step_ms and send the final
+//   command at start + transition_ms; a newer command for the target stops the fade
+// - An "all" fade broadcasts until a newer command takes over one target; from then on
+//   it addresses every other known target by name, so the taken-over one is left alone
+
+#include <string.h>
+
+#include "CmdWheel.h"
+
+#define WHEEL_MASK     (CMD_WHEEL_SIZE - 1)
+
+static cmd_wheel_config_t s_cfg;
+static cmd_wheel_entry_t *s_free = NULL;
+static size_t   s_nfree = 0;
+static cmd_wheel_entry_t *s_wheel[CMD_WHEEL_LEVELS][CMD_WHEEL_SIZE];
+static cmd_wheel_entry_t *s_overflow = NULL;
+static uint32_t s_now = 0;      // next tick to process
+static uint32_t s_seq = 0;
+static uint32_t s_use = 0;
+static uint32_t s_moves = 0;
+static size_t   s_pinned = 0;   // target slots with refs > 0
+
+/* ---------- tiny helpers ---------- */
+static void copy_str(char *dst, size_t sz, const char *src){
+    size_t n = strlen(src);
+    if (n >= sz) n = sz - 1;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+}
+static uint32_t ms_to_ticks(uint64_t ms){
+    return (uint32_t)((ms + s_cfg.tick_ms - 1) / s_cfg.tick_ms);
+}
+static uint8_t lerp8(uint8_t from, uint8_t to, uint64_t num, uint64_t den){
+    return (uint8_t)((int64_t)from + ((int64_t)to - from) * (int64_t)num / (int64_t)den);
+}
+
+/* ---------- wheel ---------- */
+static void wheel_insert(cmd_wheel_entry_t *e){
+    int32_t delta = (int32_t)(e->expires - s_now);
+    if (delta < 0) { e->expires = s_now; delta = 0; }   // overdue -> fire on the next tick
+
+    s_moves++;
+    if ((uint32_t)delta > CMD_WHEEL_MAX_TICKS) {
+        e->next = s_overflow;
+        s_overflow = e;
+        return;
+    }
+
+    int lvl = 0;
+    while (lvl < CMD_WHEEL_LEVELS - 1 && (uint32_t)delta >= (1u << (CMD_WHEEL_BITS * (lvl + 1)))) lvl++;
+
+    cmd_wheel_entry_t **slot = &s_wheel[lvl][(e->expires >> (CMD_WHEEL_BITS * lvl)) & WHEEL_MASK];
+    e->next = *slot;
+    *slot = e;
+}
+static void wheel_cascade(int lvl, uint32_t idx){
+    cmd_wheel_entry_t *e = s_wheel[lvl][idx];
+    s_wheel[lvl][idx] = NULL;
+    while (e) {
+        cmd_wheel_entry_t *n = e->next;
+        wheel_insert(e);
+        e = n;
+    }
+}
+// Pull overflow entries that now fit into the wheel
+static void overflow_recheck(void){
+    cmd_wheel_entry_t **pp = &s_overflow;
+    while (*pp) {
+        cmd_wheel_entry_t *e = *pp;
+        if (e->expires - s_now <= CMD_WHEEL_MAX_TICKS) {
+            *pp = e->next;
+            wheel_insert(e);
+        } else {
+            pp = &e->next;
+        }
+    }
+}
+// Process tick s_now: cascade higher levels on wrap, return the expired list
+static cmd_wheel_entry_t *wheel_advance(void){
+    uint32_t idx = s_now & WHEEL_MASK;
+    if (idx == 0) {
+        for (int lvl = 1; lvl < CMD_WHEEL_LEVELS; ++lvl) {
+            uint32_t i = (s_now >> (CMD_WHEEL_BITS * lvl)) & WHEEL_MASK;
+            wheel_cascade(lvl, i);
+            if (i) break;
+        }
+        if ((s_now & CMD_WHEEL_MAX_TICKS) == 0 && s_overflow) overflow_recheck();
+    }
+    cmd_wheel_entry_t *due = s_wheel[0][idx];
+    s_wheel[0][idx] = NULL;
+    s_now++;
+    return due;
+}
+
+/* ---------- targets ---------- */
+static int target_find(const char *name){
+    for (size_t i = 0; i < s_cfg.n_targets; ++i) {
+        if (s_cfg.targets[i].name[0] && strcmp(s_cfg.targets[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+// Recycle the least recently used slot for a new target name
+static int target_claim(const char *name){
+    int victim = -1;
+    for (size_t i = 0; i < s_cfg.n_targets; ++i) {
+        cmd_wheel_target_t *t = &s_cfg.targets[i];
+        // Only unreferenced slots may be recycled, so a running fade keeps its seq
+        if (t->refs == 0 && (victim < 0 || t->used < s_cfg.targets[victim].used)) victim = (int)i;
+    }
+    if (victim < 0) return -1;
+
+    cmd_wheel_target_t *t = &s_cfg.targets[victim];
+    memset(t, 0, sizeof(*t));           // unknown target: assume off
+    copy_str(t->name, sizeof(t->name), name);
+    t->r = t->g = t->b = 0xFF;
+    return victim;
+}
+static bool target_is_all(const cmd_wheel_target_t *t){
+    return strcmp(t->name, "all") == 0;
+}
+static void target_set(cmd_wheel_target_t *t, bool on, uint8_t r, uint8_t g, uint8_t b, uint8_t bri){
+    t->on = on; t->r = r; t->g = g; t->b = b; t->bri = bri;
+}
+// Target taken over by a command that began after the one with `seq`
+static bool target_newer(const cmd_wheel_target_t *t, uint32_t seq){
+    return (int32_t)(t->seq - seq) > 0;
+}
+
+/* ---------- firing ---------- */
+static void entry_free(cmd_wheel_entry_t *e){
+    if (--s_cfg.targets[e->target].refs == 0) s_pinned--;
+    e->next = s_free;
+    s_free = e;
+    s_nfree++;
+}
+static void emit_to(const cmd_wheel_entry_t *e, cmd_wheel_target_t *t,
+                    bool on, uint8_t r, uint8_t g, uint8_t b, uint8_t bri){
+    gw_cmd_t c = {0};
+    c.valid = true;
+    c.on = on; c.r = r; c.g = g; c.b = b; c.brightness = bri;
+    c.transition_ms = e->transition_ms;
+    copy_str(c.id, sizeof(c.id), e->id);
+    copy_str(c.target, sizeof(c.target), t->name);
+    target_set(t, on, r, g, b, bri);
+    s_cfg.emit(&c);
+}
+static void entry_emit(cmd_wheel_entry_t *e, bool on, uint8_t r, uint8_t g, uint8_t b, uint8_t bri){
+    cmd_wheel_target_t *t = &s_cfg.targets[e->target];
+    if (!target_is_all(t)) {
+        emit_to(e, t, on, r, g, b, bri);
+        return;
+    }
+
+    // A broadcast would overwrite a target that a newer command has taken over
+    for (size_t i = 0; i < s_cfg.n_targets && !e->split; ++i) {
+        if (target_newer(&s_cfg.targets[i], e->seq)) e->split = true;
+    }
+    if (!e->split) {
+        emit_to(e, t, on, r, g, b, bri);
+        for (size_t i = 0; i < s_cfg.n_targets; ++i) target_set(&s_cfg.targets[i], on, r, g, b, bri);
+        return;
+    }
+
+    target_set(t, on, r, g, b, bri);
+    for (size_t i = 0; i < s_cfg.n_targets; ++i) {
+        cmd_wheel_target_t *o = &s_cfg.targets[i];
+        if (o == t || !o->name[0] || target_newer(o, e->seq)) continue;
+        emit_to(e, o, on, r, g, b, bri);
+    }
+}
+// Step `step` of the fade, i.e. the level at start + step*step_ms
+static void entry_emit_step(cmd_wheel_entry_t *e){
+    uint64_t num = (uint64_t)e->step * s_cfg.step_ms, den = e->transition_ms;
+    uint8_t to_bri = e->on ? e->brightness : 0;
+    entry_emit(e, true,
+               lerp8(e->from_r, e->r, num, den), lerp8(e->from_g, e->g, num, den),
+               lerp8(e->from_b, e->b, num, den), lerp8(e->from_bri, to_bri, num, den));
+}
+// Arm the next step, or the final command once the next step would reach transition_ms
+static void entry_arm_next(cmd_wheel_entry_t *e){
+    uint64_t next_ms = (uint64_t)(e->step + 1) * s_cfg.step_ms;
+    if (next_ms > e->transition_ms) next_ms = e->transition_ms;
+    e->expires = e->start + ms_to_ticks(next_ms);
+}
+
+// Returns true if the entry must be re-armed (transition still running)
+static bool entry_fire(cmd_wheel_entry_t *e){
+    cmd_wheel_target_t *t = &s_cfg.targets[e->target];
+    uint32_t now = s_now - 1;
+
+    if (e->seq == 0) {
+        // First firing: this command now owns the target, older fades stop
+        if (++s_seq == 0) s_seq = 1;
+        e->seq = s_seq;
+        t->seq = e->seq;
+        if (target_is_all(t)) {
+            for (size_t i = 0; i < s_cfg.n_targets; ++i) s_cfg.targets[i].seq = e->seq;
+        }
+
+        int32_t late = (int32_t)(now - e->start);
+        uint64_t elapsed_ms = late > 0 ? (uint64_t)late * s_cfg.tick_ms : 0;
+        if (elapsed_ms >= e->transition_ms) {
+            entry_emit(e, e->on, e->r, e->g, e->b, e->brightness);
+            return false;
+        }
+
+        e->from_r = t->r; e->from_g = t->g; e->from_b = t->b;
+        e->from_bri = t->on ? t->bri : 0;
+        // Arrived late: join the fade at the step every other gateway is already on
+        e->step = (uint32_t)(elapsed_ms / s_cfg.step_ms);
+        if (e->step) entry_emit_step(e);
+        entry_arm_next(e);
+        return true;
+    }
+
+    if (t->seq != e->seq) return false;     // superseded by a newer command (for "all": a newer "all")
+
+    if ((uint64_t)(e->step + 1) * s_cfg.step_ms >= e->transition_ms) {
+        entry_emit(e, e->on, e->r, e->g, e->b, e->brightness);
+        return false;
+    }
+    e->step++;
+    entry_emit_step(e);
+    entry_arm_next(e);
+    return true;
+}
+
+/* ---------- public ---------- */
+void cmd_wheel_init(const cmd_wheel_config_t *cfg, uint32_t now){
+    s_cfg = *cfg;
+    if (s_cfg.tick_ms == 0) s_cfg.tick_ms = 1;
+    if (s_cfg.step_ms == 0) s_cfg.step_ms = s_cfg.tick_ms;
+
+    memset(s_wheel, 0, sizeof(s_wheel));
+    memset(s_cfg.targets, 0, s_cfg.n_targets * sizeof(cmd_wheel_target_t));
+    s_overflow = NULL;
+    s_free = NULL;
+    for (size_t i = s_cfg.n_entries; i-- > 0;) {
+        s_cfg.entries[i].next = s_free;
+        s_free = &s_cfg.entries[i];
+    }
+    s_nfree = s_cfg.n_entries;
+    s_now = now;
+    s_seq = s_use = s_moves = 0;
+    s_pinned = 0;
+}
+
+bool cmd_wheel_add(const gw_cmd_t *c, uint32_t start){
+    // Future commands leave the reserve alone, so a full wheel never blocks immediate ones
+    bool due = (int32_t)(start - s_now) <= 0;
+    if (s_nfree <= (due ? 0 : s_cfg.reserve_entries)) return false;
+
+    int ti = target_find(c->target);
+    if (ti < 0) {
+        if (!due && s_cfg.n_targets - s_pinned <= s_cfg.reserve_targets) return false;
+        ti = target_claim(c->target);
+        if (ti < 0) return false;
+    }
+    cmd_wheel_target_t *t = &s_cfg.targets[ti];
+    if (t->refs++ == 0) s_pinned++;
+    t->used = ++s_use;
+
+    cmd_wheel_entry_t *e = s_free;
+    s_free = e->next;
+    s_nfree--;
+    memset(e, 0, sizeof(*e));
+    e->target = (uint16_t)ti;
+    e->on = c->on;
+    e->r = c->r; e->g = c->g; e->b = c->b; e->brightness = c->brightness;
+    e->transition_ms = c->transition_ms;
+    copy_str(e->id, sizeof(e->id), c->id);
+    e->start = start;
+    e->expires = start;
+    wheel_insert(e);
+    return true;
+}
+
+uint32_t cmd_wheel_start_tick(int64_t exec_at_ms, int64_t now_epoch_ms, uint32_t now_tick){
+    if (exec_at_ms <= 0) return now_tick;
+    int64_t delay_ms = exec_at_ms - now_epoch_ms;
+    int64_t ticks = delay_ms >= 0 ? (delay_ms + s_cfg.tick_ms - 1) / s_cfg.tick_ms
+                                  : -((-delay_ms) / s_cfg.tick_ms);
+    if (ticks < -CMD_WHEEL_MAX_LATE_TICKS) ticks = -CMD_WHEEL_MAX_LATE_TICKS;
+    if (ticks > INT32_MAX) ticks = INT32_MAX;
+    return now_tick + (uint32_t)(int32_t)ticks;
+}
+
+void cmd_wheel_run(uint32_t now){
+    while ((int32_t)(now - s_now) >= 0) {
+        cmd_wheel_entry_t *e = wheel_advance();
+        while (e) {
+            cmd_wheel_entry_t *n = e->next;
+            if (entry_fire(e)) wheel_insert(e);
+            else entry_free(e);
+            e = n;
+        }
+    }
+}
+
+uint32_t cmd_wheel_tick(void){
+    return s_now - 1;
+}
+
+size_t cmd_wheel_free(void){
+    return s_nfree;
+}
+
+uint32_t cmd_wheel_moves(void){
+    return s_moves;
+}
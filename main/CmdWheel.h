@@ -0,0 +1,95 @@
+#pragma once
+// Plain-C core of the command scheduler: hierarchical timer wheel, entry pool,
+// per-target state and fade interpolation. Knows nothing about FreeRTOS or
+// wall-clock time; the caller drives it with a monotonic tick counter.
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parsed cloud command (filled by parse_command_json() in main.c)
+typedef struct {
+    bool   valid;
+    bool   on;
+    uint8_t r, g, b;
+    uint8_t brightness;    // 0..255
+    int64_t exec_at_ms;    // Unix epoch ms (SNTP time); 0 = execute now
+    uint32_t transition_ms;// fade duration; 0 = jump straight to target
+    char   id[64];         // commandId or hash
+    char   target[64];     // deviceId/targetId/nodeId
+} gw_cmd_t;
+
+#define CMD_WHEEL_BITS      6
+#define CMD_WHEEL_SIZE      (1u << CMD_WHEEL_BITS)
+#define CMD_WHEEL_LEVELS    4
+#define CMD_WHEEL_MAX_TICKS ((1u << (CMD_WHEEL_BITS * CMD_WHEEL_LEVELS)) - 1)  // beyond -> overflow list
+#define CMD_WHEEL_ID_LEN    64     // full commandId, same size as gw_cmd_t.id
+#define CMD_WHEEL_MAX_LATE_TICKS (1 << 30)
+
+// Pending command. Target is an index into the target table, so an entry is ~100 bytes
+// (mostly the commandId, which is passed to the mesh unchanged).
+typedef struct cmd_wheel_entry {
+    struct cmd_wheel_entry *next;
+    uint32_t expires;       // next fire tick
+    uint32_t start;         // execute-at tick (may be in the past)
+    uint32_t seq;           // target generation taken when execution began (0 = pending)
+    uint32_t step;          // last transition step sent
+    uint32_t transition_ms;
+    uint16_t target;
+    bool     split;         // "all" fade that now addresses targets one by one
+    bool     on;
+    uint8_t  r, g, b, brightness;
+    uint8_t  from_r, from_g, from_b, from_bri;
+    char     id[CMD_WHEEL_ID_LEN];
+} cmd_wheel_entry_t;
+
+// Last level sent to a target. Pinned (never evicted) while entries refer to it.
+typedef struct {
+    char     name[64];
+    bool     on;
+    uint8_t  r, g, b, bri;
+    uint16_t refs;
+    uint32_t seq;
+    uint32_t used;
+} cmd_wheel_target_t;
+
+typedef void (*cmd_wheel_emit_fn)(const gw_cmd_t *c);
+
+typedef struct {
+    uint32_t tick_ms;
+    uint32_t step_ms;               // transition step interval
+    cmd_wheel_emit_fn emit;
+    cmd_wheel_entry_t *entries;     // caller-owned pool
+    size_t n_entries;
+    cmd_wheel_target_t *targets;    // caller-owned table
+    size_t n_targets;
+    size_t reserve_entries;         // kept back for commands that are due now or late
+    size_t reserve_targets;         // unpinned target slots kept back likewise
+} cmd_wheel_config_t;
+
+// Reset everything; tick `now` is the first one cmd_wheel_run() will process.
+void cmd_wheel_init(const cmd_wheel_config_t *cfg, uint32_t now);
+
+// Queue a command to start at `start` (may be in the past -> fires on the next
+// tick, fades join late). `start` must be less than 2^31 ticks ahead.
+// False if the entry pool or the target table is full. Commands starting in the
+// future also get false once only the reserve is left, so a wheel filled with
+// far-off commands still has room for immediate ones.
+bool cmd_wheel_add(const gw_cmd_t *c, uint32_t start);
+
+// Wheel tick for a command due at `exec_at_ms` (epoch ms, 0 = now) when the wall clock
+// reads `now_epoch_ms` at tick `now_tick`. Future delays round up to whole ticks; late
+// commands keep their real (past) start, at most CMD_WHEEL_MAX_LATE_TICKS back, so fades
+// join where the others are. Uses only the tick_ms given to cmd_wheel_init().
+uint32_t cmd_wheel_start_tick(int64_t exec_at_ms, int64_t now_epoch_ms, uint32_t now_tick);
+
+// Process every tick up to and including `now`, emitting due commands.
+void cmd_wheel_run(uint32_t now);
+
+// Tick currently being processed (valid inside the emit callback)
+uint32_t cmd_wheel_tick(void);
+
+// Number of free entries
+size_t cmd_wheel_free(void);
+
+// Total slot insertions including cascades (diagnostics / cost tests)
+uint32_t cmd_wheel_moves(void);
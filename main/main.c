@@ -18,11 +18,13 @@
 #include "esp_event.h"
 #include "esp_http_client.h"
 #include "esp_netif.h"
+#include "esp_netif_sntp.h"
 #include "esp_wifi.h"
 #include "driver/gpio.h"
 
 #include "cJSON.h"
 #include "WifiManagerCustom.h"
+#include "CmdScheduler.h"
 
 #if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
 #include "esp_crt_bundle.h"
@@ -32,6 +34,7 @@
 #define GW_API_KEY     CONFIG_GW_API_KEY
 #define GW_DEVICE_ID   CONFIG_GW_DEVICE_ID
 #define GW_URL_LATEST  CONFIG_GW_URL_LATEST
+#define GW_SNTP_SERVER CONFIG_GW_SNTP_SERVER
 // No status POST URL on purpose (we're disabling POSTs)
 
 // ======== Logs ========
@@ -178,15 +181,9 @@ static esp_err_t http_get(const char *url, const char *api_key, char **out)
     return ESP_OK;
 }
 
-// ======== Command parse & dispatch ========
-typedef struct {
-    bool   valid;
-    bool   on;
-    uint8_t r, g, b;
-    uint8_t brightness;    // 0..255
-    char   id[64];         // commandId or hash
-    char   target[64];     // deviceId/targetId/nodeId
-} gw_cmd_t;
+// ======== Command parse & dispatch (gw_cmd_t lives in CmdWheel.h) ========
+#define GW_MAX_TRANSITION_MS  3600000u         // 1h cap on a single fade
+#define GW_EXEC_AT_CEIL_MS    4102444800000.0   // 2100-01-01; anything later is clamped before the cast
 
 static bool parse_hex2(const char *s, uint8_t *out) {
     int v = 0;
@@ -257,6 +254,20 @@ static gw_cmd_t parse_command_json(const char *json)
         }
     }
 
+    // Optional timing: executeAt = Unix epoch ms (or s), transitionMs = fade duration
+    const cJSON *jat = cJSON_GetObjectItemCaseSensitive(root, "executeAt");
+    if (cJSON_IsNumber(jat) && jat->valuedouble > 0) {
+        double at = jat->valuedouble;
+        if (at < 1e11) at *= 1000.0;   // seconds -> ms
+        if (at > GW_EXEC_AT_CEIL_MS) at = GW_EXEC_AT_CEIL_MS;   // e.g. 1e30; submit() rejects it as too far
+        out.exec_at_ms = (int64_t)at;
+    }
+    const cJSON *jtr = cJSON_GetObjectItemCaseSensitive(root, "transitionMs");
+    if (cJSON_IsNumber(jtr) && jtr->valuedouble > 0) {
+        double tr = jtr->valuedouble;
+        out.transition_ms = tr > GW_MAX_TRANSITION_MS ? GW_MAX_TRANSITION_MS : (uint32_t)tr;
+    }
+
     out.valid = have_cmd;
     cJSON_Delete(root);
     return out;
@@ -286,8 +297,12 @@ static void poll_task(void *arg)
 
                 gw_cmd_t c = parse_command_json(p);
                 if (c.valid && strcmp(s_last_cmd_id, c.id) != 0) {
-                    strlcpy(s_last_cmd_id, c.id, sizeof(s_last_cmd_id));
-                    forward_to_mesh_stub(&c);
+                    // Scheduler full / clock not synced -> leave it un-deduped so the next poll retries
+                    esp_err_t err = cmd_scheduler_submit(&c);
+                    if (err == ESP_ERR_INVALID_STATE) forward_to_mesh_stub(&c);
+                    if (err != ESP_ERR_NO_MEM && err != ESP_ERR_NOT_FINISHED) {
+                        strlcpy(s_last_cmd_id, c.id, sizeof(s_last_cmd_id));
+                    }
                 }
             } else {
                 ESP_LOGI(TAG, "latest-command:");
@@ -328,7 +343,7 @@ static void wifi_event_handler(void* arg, esp_event_base_t base, int32_t id, voi
 // ======== app_main ========
 void app_main(void)
 {
-    ESP_LOGI(TAG, "BUILD MARK: GPIO0 long-press erase | GET-only poller");
+    ESP_LOGI(TAG, "BUILD MARK: GPIO0 long-press erase | GET-only poller | timer-wheel scheduler");
 
     // NVS (must succeed for Wi-Fi creds to persist)
     esp_err_t ret = nvs_flash_init();
@@ -343,6 +358,9 @@ void app_main(void)
     esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL, &h1);
     esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL, &h2);
 
+    // Timer wheel: every command (immediate, scheduled, fading) reaches the mesh from here
+    cmd_scheduler_start(forward_to_mesh_stub);
+
     // Start button monitor (GPIO0 long-press)
     xTaskCreatePinnedToCore(wifi_clear_button_task, "btn", 2048, NULL, 10, NULL, 0);
 
@@ -350,6 +368,10 @@ void app_main(void)
     ESP_LOGI(TAG, "Gateway starting: Wi-Fi manager init");
     wifi_manager_start();  // NOTE: this returns void in your project
 
+    // SNTP for executeAt (netif is up after wifi_manager_start; syncs once STA has IP)
+    esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(GW_SNTP_SERVER);
+    esp_netif_sntp_init(&sntp_cfg);
+
 #if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
     ESP_LOGI(TAG, "HTTPS cert bundle enabled");
 #endif